@@ -2,58 +2,403 @@
 #include <vector>
 #include <string>
 #include <utility>
+#include <array>
+#include <iterator>
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 using namespace std;
 
+// Class Tracer: Opt-in execution tracing (enabled with --trace <file>).
+// Hot paths record scoped begin/end events into a ring buffer owned by the recording thread, so recording
+// takes no lock; when the program exits the events are exported as Chrome trace-event JSON, which
+// chrome://tracing and Perfetto open directly. When tracing is off a scope costs one relaxed atomic load.
+class Tracer{
+    private:
+        // Struct Event: One begin ('B') or end ('E') event
+        struct Event{
+            const char* name; // Scope name (string literal)
+            uint64_t timestamp; // Nanoseconds since tracing started
+            char phase;
+        };
+
+        // Struct ThreadBuffer: Ring buffer of one thread (the oldest events are overwritten when it is full)
+        struct ThreadBuffer{
+            static constexpr size_t capacity = 1 << 16;
+            Event events[capacity];
+            atomic<uint64_t> head{0}; // Number of events written so far
+            int tid; // Thread number shown in the trace
+        };
+
+        atomic<bool> enabled{false};
+        string outputPath; // Where the trace is exported at exit
+        chrono::steady_clock::time_point origin; // Time zero of the trace
+        mutex registryLock; // Guards buffers (taken once per thread, when it records its first event)
+        vector<unique_ptr<ThreadBuffer>> buffers; // Buffers of every thread that recorded events
+
+        static Tracer& global(){
+            static Tracer tracer;
+            return tracer;
+        }
+
+        // Get the calling thread's buffer, creating it on its first event (nullptr if it cannot be created)
+        ThreadBuffer* threadBuffer() noexcept{
+            thread_local ThreadBuffer* buffer = nullptr;
+            if (buffer == nullptr) {
+                unique_ptr<ThreadBuffer> created(new (nothrow) ThreadBuffer);
+                if (created == nullptr) return nullptr;
+                try {
+                    lock_guard<mutex> guard(registryLock);
+                    created->tid = buffers.size() + 1;
+                    buffers.push_back(move(created));
+                    buffer = buffers.back().get();
+                } catch (const exception&) {
+                    return nullptr; // Drop this event instead of failing the traced code (retried on the next one)
+                }
+            }
+            return buffer;
+        }
+
+        // Write every recorded event to the output file
+        static void exportAtExit(){
+            Tracer& tracer = global();
+            tracer.enabled.store(false);
+            lock_guard<mutex> guard(tracer.registryLock);
+
+            ofstream out(tracer.outputPath);
+            out << "{\"traceEvents\":[\n";
+            out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << getpid() << ",\"tid\":0,\"args\":{\"name\":\"E-Commerce\"}}";
+            char timestamp[32];
+            for (auto& buffer : tracer.buffers){
+                uint64_t head = buffer->head.load(memory_order_acquire);
+                uint64_t first = head > ThreadBuffer::capacity ? head - ThreadBuffer::capacity : 0;
+                for (uint64_t i = first; i < head; i++){
+                    const Event& event = buffer->events[i % ThreadBuffer::capacity];
+                    snprintf(timestamp, sizeof(timestamp), "%.3f", event.timestamp / 1000.0); // Microseconds
+                    out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << timestamp
+                        << ",\"pid\":" << getpid() << ",\"tid\":" << buffer->tid << "}";
+                }
+            }
+            out << "\n]}\n";
+            if (!out) cerr << "Cannot write trace to " << tracer.outputPath << endl;
+        }
+
+    public:
+        // Start recording; the trace is written to the given file when the program exits
+        static void start(const string& path){
+            Tracer& tracer = global();
+            tracer.outputPath = path;
+            tracer.origin = chrono::steady_clock::now();
+            atexit(exportAtExit);
+            tracer.enabled.store(true);
+        }
+
+        static bool isEnabled() noexcept {return global().enabled.load(memory_order_relaxed);}
+
+        // Record one event on the calling thread's ring buffer
+        static void record(const char* name, char phase) noexcept{
+            Tracer& tracer = global();
+            ThreadBuffer* buffer = tracer.threadBuffer();
+            if (buffer == nullptr) return;
+
+            uint64_t head = buffer->head.load(memory_order_relaxed);
+            Event& event = buffer->events[head % ThreadBuffer::capacity];
+            event.name = name;
+            event.timestamp = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - tracer.origin).count();
+            event.phase = phase;
+            buffer->head.store(head + 1, memory_order_release); // Publish the event to the exporter
+        }
+};
+
+// Class TraceScope: Records a begin event when created and the matching end event when destroyed
+class TraceScope{
+    private:
+        const char* name; // Scope name, or nullptr if tracing was off when the scope began
+
+    public:
+        TraceScope(const char* _name) noexcept: name(Tracer::isEnabled() ? _name : nullptr){
+            if (name != nullptr) Tracer::record(name, 'B');
+        }
+
+        ~TraceScope(){
+            if (name != nullptr) Tracer::record(name, 'E');
+        }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+};
+
+// Trace the rest of the enclosing block under the given name
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
 // Class Discountable: Interface for objects that can apply a discount. 
 // Derived classes must define how to calculate the discounted price.
+// Pricing is pure: it never modifies the object, so any number of threads may price the same product at once.
 class Discountable{
     public:
-        virtual double applyDiscount(double rate) = 0;
+        virtual double applyDiscount(double rate) const noexcept = 0;
+};
+
+// Type SkuKey: Product identifier packed into an integer, one byte per character with the first character
+// in the highest byte, so keys compare and sort in the same order as the ID strings.
+typedef uint64_t SkuKey;
+
+// Check that an ID fits in a SkuKey (1 to 8 characters)
+bool isValidSku(const string& ID) noexcept{
+    return !ID.empty() && ID.size() <= sizeof(SkuKey) && ID.find('\0') == string::npos;
+}
+
+// Pack an ID into its key
+SkuKey encodeSku(const string& ID) noexcept{
+    SkuKey key = 0;
+    for (size_t i = 0; i < sizeof(SkuKey); i++) key = (key << 8) | (i < ID.size() ? (unsigned char)ID[i] : 0);
+    return key;
+}
+
+// Unpack a key into a buffer of at least sizeof(SkuKey) characters (returns the length of the ID)
+size_t unpackSku(SkuKey key, char* ID) noexcept{
+    size_t length = 0;
+    for (int shift = 8 * (sizeof(SkuKey) - 1); shift >= 0 && (char)(key >> shift) != '\0'; shift -= 8) ID[length++] = (char)(key >> shift);
+    return length;
+}
+
+// Unpack a key into its ID
+string decodeSku(SkuKey key){
+    char ID[sizeof(SkuKey)];
+    return string(ID, unpackSku(key, ID));
+}
+
+// Class NamePool: Stores each distinct product name once; products refer to their name by pointer.
+// Equal names always share the same pointer, so comparing names is a single pointer compare.
+class NamePool{
+    private:
+        unordered_set<string> names; // Interned names (elements never move once inserted)
+        mutex lock; // Guards the set (names are added from any thread)
+
+        static NamePool& global(){
+            static NamePool pool;
+            return pool;
+        }
+
+    public:
+        // Get the pooled copy of a name, adding it if needed
+        static const string* intern(const string& name){
+            NamePool& pool = global();
+            lock_guard<mutex> guard(pool.lock);
+            return &*pool.names.insert(name).first;
+        }
+
+        // Get the pooled copy of a name, or nullptr if no product has ever had this name
+        static const string* find(const string& name){
+            NamePool& pool = global();
+            lock_guard<mutex> guard(pool.lock);
+            auto it = pool.names.find(name);
+            return it == pool.names.end() ? nullptr : &*it;
+        }
+};
+
+// Class RenderBuffer: Reusable output buffer that formats text and numbers without iostream.
+// Numbers are formatted with to_chars exactly like cout's default (6 significant digits),
+// and the finished text is emitted with a single write.
+class RenderBuffer{
+    private:
+        string data; // Formatted text (capacity is kept between uses)
+
+    public:
+        RenderBuffer& operator<<(const string& text){data += text; return *this;}
+        RenderBuffer& operator<<(const char* text){data += text; return *this;}
+        RenderBuffer& operator<<(char c){data += c; return *this;}
+
+        // Append a number formatted like cout's default floating-point output
+        RenderBuffer& operator<<(double value){
+            char digits[32];
+            auto result = to_chars(digits, digits + sizeof(digits), value, chars_format::general, 6);
+            data.append(digits, result.ptr);
+            return *this;
+        }
+
+        // Append an integer
+        RenderBuffer& operator<<(int value){
+            char digits[16];
+            auto result = to_chars(digits, digits + sizeof(digits), value);
+            data.append(digits, result.ptr);
+            return *this;
+        }
+
+        void clear(){data.clear();} // Empty the buffer but keep its memory
+        const string& str() const {return data;} // Get the formatted text
+
+        // Emit the whole buffer with one write
+        void writeTo(ostream& os) const {os.write(data.data(), data.size());}
+
+        // Get this thread's scratch buffer, emptied and ready to reuse
+        static RenderBuffer& scratch(){
+            thread_local RenderBuffer buffer;
+            buffer.clear();
+            return buffer;
+        }
+};
+
+// Class RenderCache: Keeps the pre-rendered display text of each product (template), keyed by product key.
+// A cached block is rebuilt only when the product's price, discount, stock or type-specific details have changed since it was rendered.
+// Each thread owns its cache, so rendering never needs a lock.
+template<typename T>
+class RenderCache{
+    private:
+        // Struct Entry: Rendered text of one product and the values it was rendered from
+        struct Entry{
+            const string* name = nullptr; // Interned name shown in the block
+            double price; // Price shown in the block
+            double rate; // Discount shown in the block
+            int amount; // Stock shown in the info block
+            uint64_t details; // Fingerprint of the type-specific lines in the info block
+            double unitPrice; // Price actually paid per unit (discount applied if any)
+            string pricing; // Name and price lines (shared by listings and carts)
+            string info; // Full product information block
+            bool hasInfo; // Whether the info block has been rendered for this amount
+        };
+
+        unordered_map<SkuKey, Entry> entries; // Cached blocks by product key
+        RenderBuffer out; // Buffer the blocks are rendered into
+
+        // Get the entry of a product, re-rendering its pricing lines if the price or discount changed
+        Entry& lookup(const T& item){
+            Entry& entry = entries[item.getKey()];
+            double price = item.getPrice();
+            double rate = item.getRate();
+            if (entry.name != &item.getName() || entry.price != price || entry.rate != rate){
+                entry.name = &item.getName();
+                entry.price = price;
+                entry.rate = rate;
+                entry.unitPrice = item.effectivePrice();
+                entry.hasInfo = false;
+
+                out.clear();
+                out << "Name: " << item.getName() << '\n';
+                out << "Price: " << price << '\n';
+                if (rate != 0.0) out << "Price (applying " << rate << "%" << " discount): " << entry.unitPrice << '\n';
+                entry.pricing = out.str();
+            }
+            return entry;
+        }
+
+    public:
+        // Get the name and price lines of a product
+        const string& pricing(const T& item){return lookup(item).pricing;}
+
+        // Get the price paid per unit of a product (discount applied if any)
+        double unitPrice(const T& item){return lookup(item).unitPrice;}
+
+        // Get the full information block of a product, re-rendering it if the stock or the details changed
+        const string& info(const T& item){
+            Entry& entry = lookup(item);
+            int amount = item.getAmount();
+            uint64_t details = item.detailsFingerprint();
+            if (!entry.hasInfo || entry.amount != amount || entry.details != details){
+                entry.amount = amount;
+                entry.details = details;
+                entry.hasInfo = true;
+
+                out.clear();
+                if (amount == 0) out << "(Out of stock)\n";
+                out << entry.pricing;
+                item.renderDetails(out);
+                out << "Amount: " << amount << '\n';
+                entry.info = out.str();
+            }
+            return entry.info;
+        }
+
+        // Get this thread's cache
+        static RenderCache& local(){
+            thread_local RenderCache cache;
+            return cache;
+        }
 };
 
 // Class Product: Represents a regular product.
 class Product: public Discountable{
     protected:
-        string name; // Product name
-        string ID; // Product identifier
+        SkuKey key; // Product identifier (packed ID)
+        const string* name; // Product name (interned in the NamePool)
         double price; // Original price
         double rate; // Discount percentage (%)
-        double discounted; // Price after applying discount
         int amount; // Stock quantity
 
     public:
-        // Constructor to initialize a product with all information
-        Product(string _name, string _ID, double _price, double _rate, int _amount): name(_name), ID(_ID), price(_price), rate(_rate), amount(_amount){}
+        // Constructor to initialize a product with all information (the ID must satisfy isValidSku)
+        Product(string _name, string _ID, double _price, double _rate, int _amount)
+        : key(encodeSku(_ID)), name(NamePool::intern(_name)), price(_price), rate(_rate), amount(_amount){
+            assert(isValidSku(_ID)); // Longer IDs would be truncated into the key (callers validate first)
+        }
 
-        string getName(){return name;} // Get product name
-        virtual double getPrice(){return price;} // Get original price
-        double getRate(){return rate;} // Get discount percentage
-        int getAmount(){return amount;} // Get stock quantity
+        const string& getName() const noexcept {return *name;} // Get product name
+        string getID() const {return decodeSku(key);} // Get product identifier
+        SkuKey getKey() const noexcept {return key;} // Get product identifier as its packed key
+        virtual double getPrice() const noexcept {return price;} // Get original price
+        double getRate() const noexcept {return rate;} // Get discount percentage
+        int getAmount() const noexcept {return amount;} // Get stock quantity
 
         void updateStock(int _amount){amount = _amount;} // Update stock quantity
         
         // Calculate the price after applying a discount
-        double applyDiscount(double rate) override{
-            discounted = price * (1 - (rate / 100));
-            return discounted;
+        double applyDiscount(double rate) const noexcept override{
+            return price * (1 - (rate / 100));
+        }
+
+        // Get the price paid per unit (the product's own discount applied if it has one)
+        double effectivePrice() const noexcept {
+            return (rate == 0.0) ? getPrice() : applyDiscount(rate);
         }
 
         // Display product information (name, price, discount if applicable)
-        virtual void displayInfo(){
-            if (amount == 0) cout << "(Out of stock)\n";
-            cout << "Name: " << name << endl;
-            cout << "Price: " << price << endl;
-            if (rate != 0.0) cout << "Price (applying " << rate << "%" << " discount): " << applyDiscount(rate) << endl;
-            cout << "Amount: " << amount << endl;
+        virtual void displayInfo(ostream& os = cout) const{
+            TRACE_SCOPE("Product::displayInfo");
+            const string& block = RenderCache<Product>::local().info(*this);
+            os.write(block.data(), block.size());
         }
 
+        // Render the lines specific to the product type (shown between the price and the amount)
+        virtual void renderDetails(RenderBuffer&) const{}
+
+        // Summarize every value renderDetails prints (the render cache compares it to detect stale blocks)
+        virtual uint64_t detailsFingerprint() const noexcept {return 0;}
+
         // Equality operator: returns true if the original prices of two products are equal
-        bool operator==(Product& other){
+        bool operator==(const Product& other) const noexcept{
             return this->price == other.price;
         }
 
         // Greater-than operator: returns true if the current product's original price is higher than the other's
-        bool operator>(Product& other){
+        bool operator>(const Product& other) const noexcept{
             return this->price > other.price;
         }
 };
@@ -64,7 +409,6 @@ class Electronics: public Product{
         int power; // Power consumption (W)
         int warrantyTime; // Warranty period (months)
         double extraFee; // Additional fee (e.g., shipping or handling)
-        double totalPrice; // Total price (base price + extra fee)
 
     public:
         // Initialize an electronic product with full details
@@ -72,67 +416,293 @@ class Electronics: public Product{
         : Product(_name, _ID, _price, _rate, _amount), power(_power), warrantyTime(_warrantyTime), extraFee(_extraFee){}
 
         // Get the final price (base price + extra fee)
-        double getPrice() override {return price + extraFee;}
+        double getPrice() const noexcept override {return price + extraFee;}
 
         // Calculate the price after applying a discount (including extra fee)
-        double applyDiscount(double rate) override {
-            totalPrice = price + extraFee;
-            discounted = totalPrice * (1 - (rate / 100));
-            return discounted;
+        double applyDiscount(double rate) const noexcept override {
+            return (price + extraFee) * (1 - (rate / 100));
         }
         
         // Display detailed information about the electronic product
-        void displayInfo() override{
-            if (amount == 0) cout << "(Out of stock)\n";
-            cout << "Name: " << name << endl;
-            cout << "Price: " << price + extraFee << endl;
-            if (rate != 0.0) cout << "Price (applying " << rate << "%" << " discount): " << applyDiscount(rate) << endl;
-            cout << "Power: " << power << endl;
-            cout << "Warranty Time: " << warrantyTime << endl;
-            cout << "Amount: " << amount << endl;
+        void displayInfo(ostream& os = cout) const override{
+            TRACE_SCOPE("Electronics::displayInfo");
+            const string& block = RenderCache<Electronics>::local().info(*this);
+            os.write(block.data(), block.size());
+        }
+
+        // Render the power and warranty lines
+        void renderDetails(RenderBuffer& out) const override{
+            out << "Power: " << power << '\n';
+            out << "Warranty Time: " << warrantyTime << '\n';
+        }
+
+        // Pack the power and warranty shown by renderDetails
+        uint64_t detailsFingerprint() const noexcept override{
+            return ((uint64_t)(uint32_t)power << 32) | (uint32_t)warrantyTime;
         }
 
         // Equality operator: returns true if the total price (base + extra fee) of two products is equal
-        bool operator==(Electronics& other){
+        bool operator==(const Electronics& other) const noexcept{
             return (this->price + this->extraFee) == (other.price + other.extraFee);
         }
 
         // Greater-than operator: returns true if the total price of the current product is higher than the other
-        bool operator>(Electronics& other){
+        bool operator>(const Electronics& other) const noexcept{
             return (this->price + this->extraFee) > (other.price + other.extraFee);
         }
 };
 
+// Size budget of the product records: a Product fits in 48 bytes and an Electronics in one 64-byte cache line
+static_assert(sizeof(Product) <= 48, "Product record exceeds its size budget");
+static_assert(sizeof(Electronics) <= 64, "Electronics record exceeds its size budget");
+
+// Struct CatalogEntry: One product of a compile-time catalog
+struct CatalogEntry{
+    string_view name; // Product name
+    string_view ID; // Product identifier
+    double price = 0; // Original price
+    double rate = 0; // Discount percentage (%)
+    int amount = 0; // Initial stock quantity
+    bool electronic = false; // Electronic product (uses the fields below)
+    int power = 0; // Power consumption (W)
+    int warrantyTime = 0; // Warranty period (months)
+    double extraFee = 0; // Additional fee
+    size_t position = 0; // Position among the catalog's products of the same type (filled in by StaticCatalog)
+};
+
+// Hash a string at compile time or at runtime (FNV-1a with a seed, then a final mix)
+constexpr uint64_t catalogHash(string_view text, uint64_t seed) noexcept{
+    uint64_t h = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+    for (char c : text){
+        h ^= (unsigned char)c;
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Class PerfectHash: Minimal perfect hash over N distinct keys, built at compile time (hash and displace).
+// Keys are split into N buckets; each bucket gets the first seed that sends all of its keys to free slots,
+// so every key owns exactly one of the N slots and a lookup is one probe followed by one comparison.
+template<size_t N>
+class PerfectHash{
+    private:
+        static constexpr uint32_t maxSeed = 1u << 12; // Seeds tried per bucket before giving up (duplicate keys)
+
+        array<uint32_t, N> seeds{}; // Seed of each bucket
+        array<uint32_t, N> slots{}; // Index of the key owning each slot
+        bool valid = true; // False if the keys could not be placed (they are not distinct)
+
+        static constexpr size_t bucketOf(string_view key) noexcept {return catalogHash(key, 0) % N;}
+
+    public:
+        constexpr PerfectHash(const array<string_view, N>& keys){
+            array<size_t, N> bucketSize{};
+            for (size_t i = 0; i < N; i++) bucketSize[bucketOf(keys[i])]++;
+
+            // Place the largest buckets first, while most slots are still free
+            array<size_t, N> order{};
+            for (size_t i = 0; i < N; i++) order[i] = i;
+            for (size_t i = 0; i < N; i++){
+                for (size_t j = i + 1; j < N; j++){
+                    if (bucketSize[order[j]] > bucketSize[order[i]]) {
+                        size_t t = order[i];
+                        order[i] = order[j];
+                        order[j] = t;
+                    }
+                }
+            }
+
+            array<bool, N> used{};
+            for (size_t o = 0; o < N && bucketSize[order[o]] > 0; o++){
+                size_t bucket = order[o];
+                bool placed = false;
+                for (uint32_t seed = 1; seed < maxSeed && !placed; seed++){
+                    // Try the seed: every key of the bucket needs a free slot of its own
+                    array<size_t, N> taken{};
+                    size_t count = 0;
+                    placed = true;
+                    for (size_t i = 0; i < N && placed; i++){
+                        if (bucketOf(keys[i]) != bucket) continue;
+                        size_t slot = catalogHash(keys[i], seed) % N;
+                        if (used[slot]) placed = false;
+                        for (size_t j = 0; j < count; j++) if (taken[j] == slot) placed = false;
+                        taken[count++] = slot;
+                    }
+
+                    if (placed) {
+                        seeds[bucket] = seed;
+                        for (size_t i = 0; i < N; i++){
+                            if (bucketOf(keys[i]) != bucket) continue;
+                            size_t slot = catalogHash(keys[i], seed) % N;
+                            used[slot] = true;
+                            slots[slot] = i;
+                        }
+                    }
+                }
+                if (!placed) {
+                    valid = false;
+                    return;
+                }
+            }
+        }
+
+        // Get the index of the only key that can be equal to the text (the caller confirms with one comparison)
+        constexpr size_t probe(string_view text) const noexcept {
+            return slots[catalogHash(text, seeds[bucketOf(text)]) % N];
+        }
+
+        constexpr bool isValid() const noexcept {return valid;} // Whether every key got its own slot
+};
+
+// Class StaticCatalog: Read-only product catalog built entirely at compile time,
+// with perfect-hash lookups by name and by ID.
+template<size_t N>
+class StaticCatalog{
+    private:
+        array<CatalogEntry, N> entries; // Catalog entries (positions filled in)
+        PerfectHash<N> byName; // Lookup by product name
+        PerfectHash<N> byID; // Lookup by product identifier
+
+        // Copy the entries and number each one among the entries of its type
+        static constexpr array<CatalogEntry, N> positioned(const CatalogEntry (&_entries)[N]){
+            array<CatalogEntry, N> result{};
+            size_t products = 0, electronics = 0;
+            for (size_t i = 0; i < N; i++){
+                result[i] = _entries[i];
+                result[i].position = _entries[i].electronic ? electronics++ : products++;
+            }
+            return result;
+        }
+
+        // Collect one string field of every entry
+        static constexpr array<string_view, N> keysOf(const CatalogEntry (&_entries)[N], string_view CatalogEntry::*field){
+            array<string_view, N> keys{};
+            for (size_t i = 0; i < N; i++) keys[i] = _entries[i].*field;
+            return keys;
+        }
+
+    public:
+        constexpr StaticCatalog(const CatalogEntry (&_entries)[N])
+        : entries(positioned(_entries)), byName(keysOf(_entries, &CatalogEntry::name)), byID(keysOf(_entries, &CatalogEntry::ID)){}
+
+        // Find an entry by name (returns its index if found or -1 if not found)
+        constexpr int findName(string_view name) const noexcept {
+            size_t i = byName.probe(name);
+            return entries[i].name == name ? (int)i : -1;
+        }
+
+        // Find an entry by ID (returns its index if found or -1 if not found)
+        constexpr int findID(string_view ID) const noexcept {
+            size_t i = byID.probe(ID);
+            return entries[i].ID == ID ? (int)i : -1;
+        }
+
+        // Whether the names and the IDs are all distinct (each got its own perfect-hash slot)
+        constexpr bool isValid() const noexcept {return byName.isValid() && byID.isValid();}
+
+        constexpr size_t size() const noexcept {return N;}
+        constexpr const CatalogEntry& operator[](size_t i) const noexcept {return entries[i];}
+        constexpr const CatalogEntry* begin() const noexcept {return entries.data();}
+        constexpr const CatalogEntry* end() const noexcept {return entries.data() + N;}
+};
+
+// Seed catalog: the core SKUs every store starts with (regular products, then electronic products)
+constexpr CatalogEntry seedEntries[] = {
+    {"Book A", "P001", 50.0, 10.0, 20},
+    {"Book B", "P002", 35.0, 5.0, 10},
+    {"Notebook C", "P003", 15.0, 0.0, 30},
+    {"Pen D", "P004", 5.0, 0.0, 100},
+    {"Backpack X", "P005", 60.0, 0.0, 15},
+    {"Water Bottle", "P006", 18.0, 5.0, 50},
+    {"Desk Lamp", "P007", 80.0, 8.0, 0}, // out of stock
+    {"Office Chair", "P008", 120.0, 12.0, 25},
+    {"Phone X", "E001", 800.0, 15.0, 5, true, 20, 12, 50.0},
+    {"Laptop Z", "E002", 1200.0, 10.0, 3, true, 65, 24, 80.0},
+    {"Headphone H", "E003", 150.0, 0.0, 15, true, 5, 6, 10.0},
+    {"Camera C", "E004", 500.0, 5.0, 7, true, 10, 12, 30.0},
+    {"Tablet T", "E005", 600.0, 12.0, 8, true, 15, 18, 40.0},
+    {"Smartwatch W", "E006", 200.0, 0.0, 20, true, 3, 6, 15.0},
+    {"Speaker S", "E007", 120.0, 0.0, 10, true, 4, 12, 8.0},
+    {"Console C", "E008", 400.0, 7.0, 0, true, 25, 24, 25.0}, // out of stock
+};
+
+constexpr StaticCatalog<size(seedEntries)> seedCatalog(seedEntries);
+static_assert(seedCatalog.isValid(), "Seed catalog names and IDs must be distinct");
+static_assert(seedCatalog.findName("Laptop Z") == 9 && seedCatalog.findID("P004") == 3 && seedCatalog.findName("Laptop") == -1,
+              "Seed catalog lookups are resolved at compile time");
+
 // Class InventoryList: Manages the inventory of a specific product type (template)
 template<typename T>
 class InventoryList {
     private:
         vector<T> storage; // List of items in stock
+        size_t seedCount = 0; // Leading items still at their seed catalog position (only these use the catalog fast path)
 
     public:
         // Constructor: initializes the inventory with an initial list of items
-        InventoryList(vector<T> _s) : storage(_s) {}
+        InventoryList(vector<T> _s) : storage(_s) {
+            for (const CatalogEntry& e : seedCatalog){
+                if (e.electronic != is_same<T, Electronics>::value) continue;
+                if (e.position != seedCount || seedCount >= storage.size()) break;
+                if (storage[seedCount].getName() != e.name || storage[seedCount].getKey() != encodeSku(string(e.ID))) break;
+                seedCount++;
+            }
+        }
 
         // Get the entire list of items in stock
-        vector<T> getStorage() { return storage; }
+        vector<T> getStorage() const { return storage; }
+
+        // Get a reference to the item stored at the given index (used to update stock in place)
+        T& getItem(int idx) { return storage[idx]; }
 
         // Add an item to the inventory
         void addItem(T& item) { storage.push_back(item); }
 
         // Remove an item by its name
-        void removeItem(T& item) {
+        void removeItem(T& item, ostream& os = cout) {
             for (int i = 0; i < storage.size(); i++) {
-                if (storage[i].getName() == item.getName()) {
+                if (&storage[i].getName() == &item.getName()) {
                     storage.erase(storage.begin() + i);
-                    cout << "Remove item successful!\n";
+                    seedCount = min(seedCount, (size_t)i); // Later seed items have shifted
+                    os << "Remove item successful!\n";
                 }
             }
         }
 
         // Find the position of an item by name (returns its index if found or -1 if not found)
-        int searchItem(string itemName) {
-            for (int i = 0; i < storage.size(); i++) {
-                if (storage[i].getName() == itemName) return i;
+        int searchItem(string itemName) const {
+            TRACE_SCOPE("InventoryList::searchItem");
+            // Core SKUs: one perfect-hash probe gives the seed position (valid while no earlier item was removed), confirmed with one comparison
+            int seed = seedCatalog.findName(itemName);
+            if (seed != -1 && seedCatalog[seed].electronic == is_same<T, Electronics>::value) {
+                size_t position = seedCatalog[seed].position;
+                if (position < seedCount && storage[position].getName() == itemName) return position;
+            }
+
+            const string* name = NamePool::find(itemName); // Hash the name once, then compare pointers
+            if (name == nullptr) return -1;
+            for (size_t i = 0; i < storage.size(); i++) {
+                if (&storage[i].getName() == name) return i;
+            }
+            return -1;
+        }
+
+        // Find the position of an item by its key (returns its index if found or -1 if not found)
+        int searchKey(SkuKey key) const noexcept {
+            TRACE_SCOPE("InventoryList::searchKey");
+            // Core SKUs: look the ID up in the seed catalog first (see searchItem)
+            char ID[sizeof(SkuKey)];
+            int seed = seedCatalog.findID(string_view(ID, unpackSku(key, ID)));
+            if (seed != -1 && seedCatalog[seed].electronic == is_same<T, Electronics>::value) {
+                size_t position = seedCatalog[seed].position;
+                if (position < seedCount && storage[position].getKey() == key) return position;
+            }
+
+            for (size_t i = 0; i < storage.size(); i++) {
+                if (storage[i].getKey() == key) return i;
             }
             return -1;
         }
@@ -149,34 +719,38 @@ class ShoppingCart{
         ShoppingCart(vector<pair<T, int>>& _chosenProductList): chosenProductList(_chosenProductList){}
     
         // Return the list of products currently in the cart
-        vector<pair<T, int>> getChosenProductList(){return chosenProductList;}
+        vector<pair<T, int>> getChosenProductList() const {
+            TRACE_SCOPE("ShoppingCart::getChosenProductList");
+            return chosenProductList;
+        }
+
+        // Read-only view of the products in the cart (no copy)
+        const vector<pair<T, int>>& chosenProducts() const {return chosenProductList;}
 
         // Calculate the total value of the cart (apply discount if the product has one)
-        double calculateTotal(){
+        double calculateTotal() const noexcept{
+            TRACE_SCOPE("ShoppingCart::calculateTotal");
             double result = 0;
-            for (auto p : chosenProductList) {
-                if (p.first.getRate() == 0.0) result += (p.first.getPrice() * p.second); // Case without discount
-                else result += (p.first.applyDiscount(p.first.getRate()) * p.second); // Case with discount
-            }
+            for (const auto& p : chosenProductList) result += p.first.effectivePrice() * p.second;
             return result;
         }
 
         // Display detailed information of all products in the cart
-        void displayCart(){
-            for (auto p : chosenProductList){
-                cout << "Name: " << p.first.getName() << endl;
-                cout << "Price: " << p.first.getPrice() << endl;
-                if (p.first.getRate() != 0.0) cout << "Price (applying " << p.first.getRate() << "%" << " discount): " << p.first.applyDiscount(p.first.getRate()) << endl;
-                cout << "Quantity: " << p.second << endl;
-
-                if (p.second != 1){
-                    cout << "Subtotal: ";
-                    if (p.first.getRate() == 0.0) cout << p.first.getPrice() * p.second;
-                    else cout << p.first.applyDiscount(p.first.getRate()) * p.second;   
-                    cout << endl;
-                }
+        void displayCart(ostream& os = cout){
+            RenderBuffer& out = RenderBuffer::scratch();
+            renderCart(out);
+            out.writeTo(os);
+        }
 
-                cout << endl;
+        // Render all products in the cart into a buffer (cached name and price lines, quantity and subtotal)
+        void renderCart(RenderBuffer& out){
+            TRACE_SCOPE("ShoppingCart::renderCart");
+            RenderCache<T>& cache = RenderCache<T>::local();
+            for (auto& p : chosenProductList){
+                out << cache.pricing(p.first);
+                out << "Quantity: " << p.second << '\n';
+                if (p.second != 1) out << "Subtotal: " << cache.unitPrice(p.first) * p.second << '\n';
+                out << '\n';
             }
         }
         
@@ -187,9 +761,12 @@ class ShoppingCart{
         }
 
         // Search for a product in the cart by name, return its index if found or -1 if not found
-        int searchItem(string itemName){
+        int searchItem(string itemName) const {
+            TRACE_SCOPE("ShoppingCart::searchItem");
+            const string* name = NamePool::find(itemName);
+            if (name == nullptr) return -1;
             for (int i = 0; i < chosenProductList.size(); i++){
-                if (chosenProductList[i].first.getName() == itemName) return i;
+                if (&chosenProductList[i].first.getName() == name) return i;
             }
             return -1;
         }
@@ -197,13 +774,16 @@ class ShoppingCart{
         // Operator -= : Remove a product from the cart
         ShoppingCart& operator-=(pair<T, int> &item){
             for (int i = 0; i < chosenProductList.size(); i++){
-                if (chosenProductList[i].first.getName() == item.first.getName()){
+                if (&chosenProductList[i].first.getName() == &item.first.getName()){
                     chosenProductList.erase(chosenProductList.begin() + i);
                     break;
                 }
             }
             return *this;
         }
+
+        // Remove every product from the cart
+        void clear(){chosenProductList.clear();}
 };
 
 // Class Order: Represents an order
@@ -217,9 +797,11 @@ class Order{
         
         // Create an order from the product cart, electronic cart and update the stock quantity
         void createOrder(ShoppingCart<Product> productCart, ShoppingCart<Electronics> electronicCart){
+            TRACE_SCOPE("Order::createOrder");
             orderedProduct = productCart.getChosenProductList();
             orderedElectronicProduct = electronicCart.getChosenProductList();
 
+            TRACE_SCOPE("Order::updateStock");
             for (auto p : orderedProduct){
                 int newAmount = p.first.getAmount() - p.second;
                 p.first.updateStock(newAmount);
@@ -232,44 +814,1120 @@ class Order{
         }
 
         // Display order details: product list, prices, and total
-        void displayOrder(ShoppingCart<Product> productCart, ShoppingCart<Electronics> electronicCart){
-            cout << "ORDER DETAILS:\n";
+        void displayOrder(ShoppingCart<Product> productCart, ShoppingCart<Electronics> electronicCart, ostream& os = cout){
+            TRACE_SCOPE("Order::displayOrder");
+            // Render the whole receipt first, then emit it with a single write
+            RenderBuffer& out = RenderBuffer::scratch();
+            out << "ORDER DETAILS:\n";
 
-            productCart.displayCart();
-            electronicCart.displayCart();
+            productCart.renderCart(out);
+            electronicCart.renderCart(out);
 
             double total = productCart.calculateTotal() + electronicCart.calculateTotal();
-            cout << "Total: " << total << endl;
+            out << "Total: " << total << '\n';
+            out.writeTo(os);
         }
+
+        // Get the ordered regular products and their quantities
+        vector<pair<Product, int>>& getOrderedProducts(){return orderedProduct;}
+
+        // Get the ordered electronic products and their quantities
+        vector<pair<Electronics, int>>& getOrderedElectronicProducts(){return orderedElectronicProduct;}
 };
 
-int main(){
-    // Create sample regular products
-    Product pA("Book A", "P001", 50.0, 10.0, 20);      
-    Product pB("Book B", "P002", 35.0, 5.0, 10);
-    Product pC("Notebook C", "P003", 15.0, 0.0, 30);   
-    Product pD("Pen D", "P004", 5.0, 0.0, 100);       
-    Product pE("Backpack X", "P005", 60.0, 0.0, 15);
-    Product pF("Water Bottle", "P006", 18.0, 5.0, 50);
-    Product pG("Desk Lamp", "P007", 80.0, 8.0, 0);     
-    Product pH("Office Chair", "P008", 120.0, 12.0, 25);
-
-    // Store all regular products in a vector
-    vector<Product> productStorage = {pA, pB, pC, pD, pE, pF, pG, pH};
-    
-    // Create sample electronic products
-    Electronics ePhone("Phone X", "E001", 800.0, 15.0, 5, 20, 12, 50.0);     
-    Electronics eLaptop("Laptop Z", "E002", 1200.0, 10.0, 3, 65, 24, 80.0);
-    Electronics eHeadphone("Headphone H", "E003", 150.0, 0.0, 15, 5, 6, 10.0);
-    Electronics eCamera("Camera C", "E004", 500.0, 5.0, 7, 10, 12, 30.0);
-    Electronics eTablet("Tablet T", "E005", 600.0, 12.0, 8, 15, 18, 40.0);
-    Electronics eSmartwatch("Smartwatch W", "E006", 200.0, 0.0, 20, 3, 6, 15.0);
-    Electronics eSpeaker("Speaker S", "E007", 120.0, 0.0, 10, 4, 12, 8.0);
-    Electronics eConsole("Console C", "E008", 400.0, 7.0, 0, 25, 24, 25.0);  // out of stock
-
-    // Store all electronic products in a vector
-    vector<Electronics> electronicsStorage = {ePhone, eLaptop, eHeadphone, eCamera, eTablet, eSmartwatch, eSpeaker, eConsole};
-        
+// Class PriceRanker: Ranks products of both types (a whole cart or any set of SKUs) by price, highest first.
+// The sort key of every product is computed once into a flat key array, which is then sorted
+// (in parallel chunks that are merged afterwards when the set is large).
+class PriceRanker{
+    public:
+        enum Criterion {ListPrice, EffectivePrice, Savings}; // Price, price after discount, or amount saved by the discount
+
+        // Struct Ranked: One product of the ranking and the value it was ranked by
+        struct Ranked{
+            const Product* product;
+            double key;
+        };
+
+    private:
+        // Struct RankKey: Sort key of one product and its position in the product list
+        struct RankKey{
+            double key;
+            uint32_t index;
+        };
+
+        static constexpr size_t parallelThreshold = 1 << 14; // Smallest set sorted on several threads
+        static constexpr unsigned maxThreads = 8;
+
+        Criterion criterion;
+        vector<const Product*> products; // Products to rank (Electronics included through their base class)
+
+        // Compute the value a product is ranked by
+        double keyOf(const Product& product) const noexcept{
+            if (criterion == ListPrice) return product.getPrice();
+            if (criterion == EffectivePrice) return product.effectivePrice();
+            return product.getPrice() - product.effectivePrice();
+        }
+
+        // Highest key first; equal keys keep the order the products were added in
+        static bool ranksBefore(const RankKey& a, const RankKey& b) noexcept{
+            return a.key != b.key ? a.key > b.key : a.index < b.index;
+        }
+
+        // Sort the keys, splitting large arrays into chunks sorted on separate threads and then merged
+        static void sortKeys(vector<RankKey>& keys){
+            size_t n = keys.size();
+            unsigned threads = min(thread::hardware_concurrency(), maxThreads);
+            if (n < parallelThreshold || threads < 2) {
+                sort(keys.begin(), keys.end(), ranksBefore);
+                return;
+            }
+
+            size_t chunk = (n + threads - 1) / threads;
+            vector<thread> workers;
+            for (size_t begin = 0; begin < n; begin += chunk){
+                size_t end = min(n, begin + chunk);
+                workers.emplace_back([&keys, begin, end]{ sort(keys.begin() + begin, keys.begin() + end, ranksBefore); });
+            }
+            for (auto& worker : workers) worker.join();
+
+            for (size_t width = chunk; width < n; width *= 2){
+                for (size_t begin = 0; begin + width < n; begin += 2 * width)
+                    inplace_merge(keys.begin() + begin, keys.begin() + begin + width, keys.begin() + min(n, begin + 2 * width), ranksBefore);
+            }
+        }
+
+    public:
+        PriceRanker(Criterion _criterion): criterion(_criterion){}
+
+        // Add one product to rank (it must outlive the ranker)
+        void add(const Product& product){products.push_back(&product);}
+
+        // Add every product of a cart
+        template<typename T>
+        void addCart(const ShoppingCart<T>& cart){
+            for (const auto& p : cart.chosenProducts()) add(p.first);
+        }
+
+        // Rank the products (highest value first)
+        vector<Ranked> rank() const{
+            TRACE_SCOPE("PriceRanker::rank");
+            vector<RankKey> keys(products.size());
+            for (size_t i = 0; i < products.size(); i++) keys[i] = {keyOf(*products[i]), (uint32_t)i};
+            sortKeys(keys);
+
+            vector<Ranked> result(keys.size());
+            for (size_t i = 0; i < keys.size(); i++) result[i] = {products[keys[i].index], keys[i].key};
+            return result;
+        }
+
+        // Display the ranking
+        void displayRanking(ostream& os = cout) const{
+            static const char* const titles[] = {"price", "price after discount", "savings"};
+            RenderBuffer& out = RenderBuffer::scratch();
+            out << "Products sorted by " << titles[criterion] << " (highest first):\n";
+            vector<Ranked> ranking = rank();
+            for (size_t i = 0; i < ranking.size(); i++)
+                out << (int)(i + 1) << ". " << ranking[i].product->getName() << ": " << ranking[i].key << '\n';
+            out.writeTo(os);
+        }
+};
+
+// Class CheckoutBatch: Checks out many orders at once against the shared inventories.
+// The lines of all carts are sorted and grouped by SKU, so each SKU is looked up once per batch.
+// Orders are then accepted in the order they were added (all of their lines or none),
+// and the stock of each SKU is written back once for the whole batch.
+class CheckoutBatch{
+    private:
+        // Struct Line: One cart line of one order
+        struct Line{
+            bool electronic; // Whether the SKU is in the electronics inventory
+            SkuKey sku; // Product identifier
+            int order; // Index of the order in the batch
+            int quantity; // Quantity ordered
+            size_t slot; // Index of the SKU among the distinct SKUs of the batch
+        };
+
+        // Struct Slot: One distinct SKU of the batch and its stock
+        struct Slot{
+            bool electronic;
+            int idx; // Position in its inventory (-1 if the product no longer exists)
+            int stock; // Stock before the batch
+            int remaining; // Stock left after the accepted orders
+        };
+
+        InventoryList<Product>& productInventory;
+        InventoryList<Electronics>& electronicInventory;
+        vector<Line> lines; // Lines of all orders, in the order they were added
+        int orderCount = 0;
+
+        // Queue the lines of one cart for the given order
+        template<typename T>
+        void addLines(ShoppingCart<T>& cart, bool electronic, int order){
+            for (auto p : cart.getChosenProductList()){
+                Line line;
+                line.electronic = electronic;
+                line.sku = p.first.getKey();
+                line.order = order;
+                line.quantity = p.second;
+                line.slot = 0;
+                lines.push_back(line);
+            }
+        }
+
+    public:
+        // Initialize a batch against the shared inventories
+        CheckoutBatch(InventoryList<Product>& _productInventory, InventoryList<Electronics>& _electronicInventory)
+        : productInventory(_productInventory), electronicInventory(_electronicInventory){}
+
+        // Add an order made of a regular product cart and an electronic product cart (returns its index in the batch)
+        int add(ShoppingCart<Product>& productCart, ShoppingCart<Electronics>& electronicCart){
+            addLines(productCart, false, orderCount);
+            addLines(electronicCart, true, orderCount);
+            return orderCount++;
+        }
+
+        // Reserve the stock of every order and update the inventories (returns whether each order succeeded)
+        vector<bool> run(){
+            TRACE_SCOPE("CheckoutBatch::run");
+            // Group the lines by SKU and look each SKU up once
+            vector<size_t> byKey(lines.size());
+            for (size_t i = 0; i < byKey.size(); i++) byKey[i] = i;
+            sort(byKey.begin(), byKey.end(), [&](size_t a, size_t b){
+                if (lines[a].electronic != lines[b].electronic) return lines[b].electronic;
+                return lines[a].sku < lines[b].sku;
+            });
+
+            vector<Slot> slots;
+            for (size_t i = 0; i < byKey.size(); i++){
+                Line& line = lines[byKey[i]];
+                if (i == 0 || line.electronic != lines[byKey[i - 1]].electronic || line.sku != lines[byKey[i - 1]].sku){
+                    Slot slot;
+                    slot.electronic = line.electronic;
+                    slot.idx = line.electronic ? electronicInventory.searchKey(line.sku) : productInventory.searchKey(line.sku);
+                    if (slot.idx == -1) slot.stock = 0;
+                    else slot.stock = line.electronic ? electronicInventory.getItem(slot.idx).getAmount() : productInventory.getItem(slot.idx).getAmount();
+                    slot.remaining = slot.stock;
+                    slots.push_back(slot);
+                }
+                line.slot = slots.size() - 1;
+            }
+
+            // Accept the orders one after another: an order takes its stock only if all of its lines fit
+            vector<bool> accepted(orderCount, false);
+            for (size_t start = 0, end; start < lines.size(); start = end){
+                for (end = start; end < lines.size() && lines[end].order == lines[start].order; end++){
+                    Slot& slot = slots[lines[end].slot];
+                    if (slot.idx == -1 || slot.remaining < lines[end].quantity) break;
+                    slot.remaining -= lines[end].quantity;
+                }
+
+                if (end < lines.size() && lines[end].order == lines[start].order){
+                    // A line did not fit: give back what the order took and skip the rest of it
+                    for (size_t i = start; i < end; i++) slots[lines[i].slot].remaining += lines[i].quantity;
+                    while (end < lines.size() && lines[end].order == lines[start].order) end++;
+                } else accepted[lines[start].order] = true;
+            }
+
+            // Write the stock of each SKU once
+            TRACE_SCOPE("CheckoutBatch::updateStock");
+            for (auto& slot : slots){
+                if (slot.idx == -1 || slot.remaining == slot.stock) continue;
+                if (slot.electronic) electronicInventory.getItem(slot.idx).updateStock(slot.remaining);
+                else productInventory.getItem(slot.idx).updateStock(slot.remaining);
+            }
+
+            lines.clear();
+            orderCount = 0;
+            return accepted;
+        }
+};
+
+// Class OrderHistory: Append-only store of every ordered line (SKU, quantity, unit price, discount, time).
+// Lines are buffered in memory and written as immutable columnar segment files, one compressed block per column:
+// SKUs are dictionary-encoded, integers are delta/varint-encoded and prices are stored as scaled integers when exact.
+// Queries read only the columns they need and filter them in tight loops over plain arrays.
+// Small segments (from frequent flushes) are merged into larger ones, so queries only open a few files.
+class OrderHistory{
+    public:
+        // Struct SkuSales: Units sold and revenue of one SKU
+        struct SkuSales{
+            string sku;
+            long long quantity = 0;
+            double revenue = 0;
+        };
+
+    private:
+        enum Column {SkuColumn, QuantityColumn, PriceColumn, RateColumn, TimeColumn, ColumnCount};
+
+        // Struct Columns: Decoded columns of one segment (only the requested ones are filled)
+        struct Columns{
+            vector<string> dictionary; // Distinct SKUs of the segment
+            vector<uint32_t> sku; // Index into the dictionary for each line
+            vector<long long> quantity;
+            vector<double> unitPrice; // Price per unit before discount
+            vector<double> rate; // Discount percentage (%)
+            vector<long long> timestamp; // Seconds since the epoch
+        };
+
+        static constexpr uint32_t segmentMagic = 0x3153484F; // "OHS1"
+        static constexpr size_t segmentRows = 4096; // Lines buffered before a segment is written
+        static constexpr size_t compactThreshold = 8; // Segments smaller than segmentRows allowed before they are merged
+        static constexpr unsigned allColumns = (1u << ColumnCount) - 1;
+        static constexpr size_t headerSize = 8 + ColumnCount * 16; // Magic, row count, column directory
+
+        string directory; // Directory holding the segment files
+        Columns pending; // Lines not written to a segment yet
+        unordered_map<string, uint32_t> pendingCodes; // Dictionary codes of the pending SKUs
+        int segmentSequence = 0; // Segments written by this process
+
+        // Append an unsigned integer as a varint (7 bits per byte)
+        static void putVarint(string& out, unsigned long long value){
+            while (value >= 0x80){
+                out += char((value & 0x7F) | 0x80);
+                value >>= 7;
+            }
+            out += char(value);
+        }
+
+        // Read a varint; returns false if the data is truncated
+        static bool getVarint(const string& in, size_t& pos, unsigned long long& value){
+            value = 0;
+            for (int shift = 0; pos < in.size() && shift < 64; shift += 7){
+                unsigned char byte = in[pos++];
+                value |= (unsigned long long)(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return true;
+            }
+            return false;
+        }
+
+        static unsigned long long zigzag(long long v){return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);}
+        static long long unzigzag(unsigned long long v){return (long long)(v >> 1) ^ -(long long)(v & 1);}
+
+        // Encode integers as zigzag deltas from the previous value
+        static string encodeIntegers(const vector<long long>& values){
+            string out;
+            long long previous = 0;
+            for (long long v : values){
+                putVarint(out, zigzag(v - previous));
+                previous = v;
+            }
+            return out;
+        }
+
+        static bool decodeIntegers(const string& in, size_t rows, vector<long long>& values){
+            values.resize(rows);
+            size_t pos = 0;
+            long long previous = 0;
+            for (size_t i = 0; i < rows; i++){
+                unsigned long long raw;
+                if (!getVarint(in, pos, raw)) return false;
+                previous += unzigzag(raw);
+                values[i] = previous;
+            }
+            return true;
+        }
+
+        // Encode prices and rates: as integers scaled by 10000 when that is exact, otherwise as raw doubles
+        static string encodeDecimals(const vector<double>& values){
+            bool scaled = true;
+            vector<long long> scaledValues(values.size());
+            for (size_t i = 0; i < values.size(); i++){
+                if (!(values[i] > -1e14 && values[i] < 1e14)) {scaled = false; break;}
+                scaledValues[i] = llround(values[i] * 10000);
+                if (scaledValues[i] / 10000.0 != values[i]) {scaled = false; break;}
+            }
+
+            string out(1, scaled ? 1 : 0);
+            if (scaled) out += encodeIntegers(scaledValues);
+            else out.append((const char*)values.data(), values.size() * sizeof(double));
+            return out;
+        }
+
+        static bool decodeDecimals(const string& in, size_t rows, vector<double>& values){
+            if (in.empty()) return rows == 0;
+            values.resize(rows);
+            if (in[0] == 0){
+                if (in.size() != 1 + rows * sizeof(double)) return false;
+                in.copy((char*)values.data(), rows * sizeof(double), 1);
+                return true;
+            }
+
+            vector<long long> scaledValues;
+            if (!decodeIntegers(in.substr(1), rows, scaledValues)) return false;
+            for (size_t i = 0; i < rows; i++) values[i] = scaledValues[i] / 10000.0;
+            return true;
+        }
+
+        // Encode the SKU column: the dictionary followed by one varint code per line
+        static string encodeSkus(const Columns& columns){
+            string out;
+            putVarint(out, columns.dictionary.size());
+            for (const string& sku : columns.dictionary){
+                putVarint(out, sku.size());
+                out += sku;
+            }
+            for (uint32_t code : columns.sku) putVarint(out, code);
+            return out;
+        }
+
+        static bool decodeSkus(const string& in, size_t rows, Columns& columns){
+            size_t pos = 0;
+            unsigned long long count, value;
+            if (!getVarint(in, pos, count) || count > in.size()) return false; // Every SKU takes at least one byte
+            columns.dictionary.resize(count);
+            for (auto& sku : columns.dictionary){
+                if (!getVarint(in, pos, value) || value > in.size() - pos) return false;
+                sku = in.substr(pos, value);
+                pos += value;
+            }
+
+            columns.sku.resize(rows);
+            for (size_t i = 0; i < rows; i++){
+                if (!getVarint(in, pos, value) || value >= count) return false;
+                columns.sku[i] = value;
+            }
+            return true;
+        }
+
+        // Add one ordered line to a set of columns (codes maps each SKU to its dictionary index)
+        static void addLine(Columns& columns, unordered_map<string, uint32_t>& codes, const string& sku, long long quantity, double unitPrice, double rate, long long timestamp){
+            auto code = codes.emplace(sku, columns.dictionary.size());
+            if (code.second) columns.dictionary.push_back(sku);
+            columns.sku.push_back(code.first->second);
+            columns.quantity.push_back(quantity);
+            columns.unitPrice.push_back(unitPrice);
+            columns.rate.push_back(rate);
+            columns.timestamp.push_back(timestamp);
+        }
+
+        // Struct StoreLock: Lock on the store directory, shared by queries and exclusive while segments change
+        // (so a query never sees both a merged segment and the segments it replaces)
+        struct StoreLock{
+            int fd;
+
+            StoreLock(const string& directory, bool exclusive): fd(open((directory + "/.lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)){
+                if (fd != -1) flock(fd, exclusive ? LOCK_EX : LOCK_SH);
+            }
+
+            ~StoreLock(){
+                if (fd != -1) close(fd); // Also releases the lock
+            }
+        };
+
+        // List the segment files of the store
+        vector<string> segmentFiles(){
+            vector<string> files;
+            error_code error;
+            for (auto& entry : filesystem::directory_iterator(directory, error)){
+                if (entry.path().extension() == ".ohs") files.push_back(entry.path().string());
+            }
+            return files;
+        }
+
+        // Read and check a segment header; returns false if the file is not a valid segment
+        static bool readHeader(ifstream& in, string& header, uint32_t& rows){
+            // Every row takes at least one byte in each column, so the file size bounds the row count
+            if (!in.seekg(0, ios::end)) return false;
+            uint64_t fileSize = in.tellg();
+            header.assign(headerSize, '\0');
+            if (fileSize < headerSize || !in.seekg(0) || !in.read(&header[0], headerSize)) return false;
+
+            uint32_t magic;
+            header.copy((char*)&magic, 4, 0);
+            header.copy((char*)&rows, 4, 4);
+            if (magic != segmentMagic || rows > fileSize) return false;
+
+            // Every column block must lie inside the file
+            for (int c = 0; c < ColumnCount; c++){
+                uint64_t offset, size;
+                header.copy((char*)&offset, 8, 8 + c * 16);
+                header.copy((char*)&size, 8, 16 + c * 16);
+                if (offset < headerSize || offset > fileSize || size > fileSize - offset) return false;
+            }
+            return true;
+        }
+
+        // Read the row count of a segment file (-1 if it is not a valid segment)
+        static long long segmentRowCount(const string& file){
+            ifstream in(file, ios::binary);
+            string header;
+            uint32_t rows;
+            return readHeader(in, header, rows) ? rows : -1;
+        }
+
+        // Read the requested columns (bit mask of Column) of one segment file; returns false if it is unreadable
+        static bool readSegment(const string& file, unsigned columnMask, Columns& columns){
+            ifstream in(file, ios::binary);
+            string header;
+            uint32_t rows;
+            if (!readHeader(in, header, rows)) return false;
+
+            for (int c = 0; c < ColumnCount; c++){
+                if (!(columnMask & (1u << c))) continue;
+
+                // Jump straight to the column's block using the directory
+                uint64_t offset, size;
+                header.copy((char*)&offset, 8, 8 + c * 16);
+                header.copy((char*)&size, 8, 16 + c * 16);
+                string block(size, '\0');
+                if (!in.seekg(offset) || !in.read(&block[0], size)) return false;
+
+                bool valid = false;
+                if (c == SkuColumn) valid = decodeSkus(block, rows, columns);
+                else if (c == QuantityColumn) valid = decodeIntegers(block, rows, columns.quantity);
+                else if (c == PriceColumn) valid = decodeDecimals(block, rows, columns.unitPrice);
+                else if (c == RateColumn) valid = decodeDecimals(block, rows, columns.rate);
+                else valid = decodeIntegers(block, rows, columns.timestamp);
+                if (!valid) return false;
+            }
+            return true;
+        }
+
+        // Run a query over every segment and the pending lines, reading only the requested columns
+        template<typename Visitor>
+        void scan(unsigned columnMask, Visitor visit){
+            {
+                StoreLock lock(directory, false);
+                for (const string& file : segmentFiles()){
+                    Columns columns;
+                    if (readSegment(file, columnMask, columns)) visit(columns); // Unreadable segments are skipped
+                }
+            }
+            if (!pending.sku.empty()) visit(pending);
+        }
+
+        // Write a set of columns as a new segment file; returns false if it could not be written
+        bool writeSegment(const Columns& columns){
+            string blocks[ColumnCount];
+            blocks[SkuColumn] = encodeSkus(columns);
+            blocks[QuantityColumn] = encodeIntegers(columns.quantity);
+            blocks[PriceColumn] = encodeDecimals(columns.unitPrice);
+            blocks[RateColumn] = encodeDecimals(columns.rate);
+            blocks[TimeColumn] = encodeIntegers(columns.timestamp);
+
+            // Header: magic, row count, then the offset and size of each column block
+            string header(headerSize, '\0');
+            uint32_t rows = columns.sku.size();
+            header.replace(0, 4, (const char*)&segmentMagic, 4);
+            header.replace(4, 4, (const char*)&rows, 4);
+            uint64_t offset = headerSize;
+            for (int c = 0; c < ColumnCount; c++){
+                uint64_t size = blocks[c].size();
+                header.replace(8 + c * 16, 8, (const char*)&offset, 8);
+                header.replace(16 + c * 16, 8, (const char*)&size, 8);
+                offset += size;
+            }
+
+            // Write under a temporary name and rename, so readers never see a partial segment
+            error_code error;
+            string name = directory + "/segment-" + to_string(time(nullptr)) + "-" + to_string(getpid()) + "-" + to_string(segmentSequence++);
+            {
+                ofstream out(name + ".tmp", ios::binary);
+                out << header;
+                for (auto& block : blocks) out << block;
+                if (!out.flush()) return false;
+            }
+            filesystem::rename(name + ".tmp", name + ".ohs", error);
+            return !error;
+        }
+
+        // Merge the small segments into one once there are compactThreshold of them (the caller holds the exclusive lock)
+        void compact(){
+            TRACE_SCOPE("OrderHistory::compact");
+            vector<string> small;
+            for (const string& file : segmentFiles()){
+                long long rows = segmentRowCount(file);
+                if (rows >= 0 && rows < (long long)segmentRows) small.push_back(file);
+            }
+            if (small.size() < compactThreshold) return;
+
+            Columns merged;
+            unordered_map<string, uint32_t> codes;
+            vector<string> mergedFiles;
+            for (const string& file : small){
+                Columns c;
+                if (!readSegment(file, allColumns, c)) continue; // Leave an unreadable segment alone
+                for (size_t i = 0; i < c.sku.size(); i++)
+                    addLine(merged, codes, c.dictionary[c.sku[i]], c.quantity[i], c.unitPrice[i], c.rate[i], c.timestamp[i]);
+                mergedFiles.push_back(file);
+            }
+
+            // Remove the small segments only once the merged one is in place
+            if (mergedFiles.size() < 2 || !writeSegment(merged)) return;
+            error_code error;
+            for (const string& file : mergedFiles) filesystem::remove(file, error);
+        }
+
+        // Sum the revenue of the lines selected by the mask (branch-free so the loop vectorizes)
+        static double maskedRevenue(const Columns& c, const vector<unsigned char>& mask){
+            double revenue = 0;
+            for (size_t i = 0; i < mask.size(); i++)
+                revenue += mask[i] * (c.quantity[i] * (c.unitPrice[i] * (1 - (c.rate[i] / 100))));
+            return revenue;
+        }
+
+    public:
+        // Open the store kept in the given directory (created on the first write)
+        OrderHistory(string _directory): directory(_directory){}
+
+        ~OrderHistory(){flush();}
+
+        // Append every line of an order
+        void append(Order& order, long long timestamp = time(nullptr)){
+            TRACE_SCOPE("OrderHistory::append");
+            for (auto p : order.getOrderedProducts())
+                addLine(pending, pendingCodes, p.first.getID(), p.second, p.first.getPrice(), p.first.getRate(), timestamp);
+            for (auto ep : order.getOrderedElectronicProducts())
+                addLine(pending, pendingCodes, ep.first.getID(), ep.second, ep.first.getPrice(), ep.first.getRate(), timestamp);
+
+            if (pending.sku.size() >= segmentRows) flush();
+        }
+
+        // Number of lines that are not written to a segment yet
+        size_t pendingLines(){return pending.sku.size();}
+
+        // Write the pending lines as a new segment file (merging small segments); returns false if it could not be written
+        bool flush(){
+            TRACE_SCOPE("OrderHistory::flush");
+            if (pending.sku.empty()) return true;
+
+            error_code error;
+            filesystem::create_directories(directory, error);
+            StoreLock lock(directory, true);
+            if (!writeSegment(pending)) return false;
+
+            pending = Columns();
+            pendingCodes.clear();
+            compact();
+            return true;
+        }
+
+        // Units sold and revenue of one SKU
+        SkuSales salesOf(const string& sku){
+            TRACE_SCOPE("OrderHistory::salesOf");
+            SkuSales result;
+            result.sku = sku;
+            scan((1u << SkuColumn) | (1u << QuantityColumn) | (1u << PriceColumn) | (1u << RateColumn), [&](const Columns& c){
+                // Resolve the SKU once per segment, then filter on the integer codes
+                uint32_t code = find(c.dictionary.begin(), c.dictionary.end(), sku) - c.dictionary.begin();
+                if (code == c.dictionary.size()) return;
+
+                vector<unsigned char> mask(c.sku.size());
+                for (size_t i = 0; i < mask.size(); i++) mask[i] = c.sku[i] == code;
+                for (size_t i = 0; i < mask.size(); i++) result.quantity += mask[i] * c.quantity[i];
+                result.revenue += maskedRevenue(c, mask);
+            });
+            return result;
+        }
+
+        // Revenue of the lines ordered in the time window [from, to)
+        double revenueBetween(long long from, long long to){
+            TRACE_SCOPE("OrderHistory::revenueBetween");
+            double revenue = 0;
+            scan((1u << TimeColumn) | (1u << QuantityColumn) | (1u << PriceColumn) | (1u << RateColumn), [&](const Columns& c){
+                vector<unsigned char> mask(c.timestamp.size());
+                for (size_t i = 0; i < mask.size(); i++) mask[i] = (c.timestamp[i] >= from) & (c.timestamp[i] < to);
+                revenue += maskedRevenue(c, mask);
+            });
+            return revenue;
+        }
+
+        // The SKUs with the most units sold, best first
+        vector<SkuSales> topSellers(int count){
+            TRACE_SCOPE("OrderHistory::topSellers");
+            unordered_map<string, long long> units;
+            scan((1u << SkuColumn) | (1u << QuantityColumn), [&](const Columns& c){
+                // Sum per dictionary code first, then merge once per distinct SKU
+                vector<long long> perCode(c.dictionary.size());
+                for (size_t i = 0; i < c.sku.size(); i++) perCode[c.sku[i]] += c.quantity[i];
+                for (size_t code = 0; code < perCode.size(); code++) units[c.dictionary[code]] += perCode[code];
+            });
+
+            vector<SkuSales> result;
+            for (auto& u : units){
+                SkuSales sales;
+                sales.sku = u.first;
+                sales.quantity = u.second;
+                result.push_back(sales);
+            }
+            sort(result.begin(), result.end(), [](const SkuSales& a, const SkuSales& b){
+                return a.quantity != b.quantity ? a.quantity > b.quantity : a.sku < b.sku;
+            });
+            if ((int)result.size() > count) result.resize(count);
+            return result;
+        }
+
+        // Display the best sellers and the revenue of the last 24 hours and of all time
+        void displayReport(ostream& os = cout){
+            long long now = time(nullptr);
+            vector<SkuSales> best = topSellers(5);
+            os << "Top sellers:\n";
+            if (best.empty()) os << "No orders yet\n";
+            for (size_t i = 0; i < best.size(); i++) os << i + 1 << ". " << best[i].sku << " - " << best[i].quantity << " sold\n";
+            os << "Revenue (last 24 hours): " << revenueBetween(now - 24 * 60 * 60, now + 1) << endl;
+            os << "Revenue (all time): " << revenueBetween(LLONG_MIN, LLONG_MAX) << endl;
+        }
+};
+
+// Class SessionServer: Serves the customer and manager operations to many clients over a Unix domain socket.
+// Every session is multiplexed on one epoll event loop, so the shared inventories are never touched concurrently.
+//
+// Protocol: one command per line, fields after the command separated by '|'. Each reply is zero or more
+// lines of output followed by a status line, "OK" or "ERR <reason>".
+//   S <name>                 Search the inventory for a product
+//   A <quantity>|<name>      Add a product to the cart
+//   R <name>                 Remove a product from the cart
+//   C <name1>|<name2>        Compare the prices of 2 products in the cart
+//   K <criterion>[|<name>...]  Sort the cart, or the named products, by 1 price, 2 price after discount or 3 savings
+//   L                        List the cart and its total
+//   O                        Order every product in the cart
+//   MP <name>|<ID>|<price>|<rate>|<amount>                                 Add a regular product (manager)
+//   ME <name>|<ID>|<price>|<rate>|<amount>|<power>|<warrantyTime>|<extraFee>  Add an electronic product (manager)
+//   MR <name>                Remove a product from the inventory (manager)
+//   MH                       Show the best sellers and the revenue (manager)
+//   Q                        Close the session
+class SessionServer{
+    private:
+        // Struct Session: State of one connected client (socket buffers and its own carts)
+        struct Session{
+            int fd; // Client socket
+            string inBuffer; // Received bytes that do not form a complete command yet
+            string outBuffer; // Replies waiting to be written to the socket
+            bool closing = false; // Close the session once the pending replies are written
+            bool peerClosed = false; // The client has finished sending (its remaining commands still run)
+            bool ordering = false; // An order is waiting for the next checkout batch (later commands wait too)
+            vector<pair<Product, int>> pCartList; // Regular product cart
+            vector<pair<Electronics, int>> eCartList; // Electronic product cart
+            ShoppingCart<Product> productCart;
+            ShoppingCart<Electronics> electronicCart;
+
+            Session(int _fd): fd(_fd), productCart(pCartList), electronicCart(eCartList){}
+        };
+
+        static const size_t maxLineLength = 4096; // Longest command accepted from a client
+        static const size_t maxInput = 64 * 1024; // Received bytes buffered per session before reading pauses
+        static const size_t maxOutput = 256 * 1024; // Unsent reply bytes per session before its commands pause
+        static const int maxEvents = 256; // Events handled per epoll_wait call
+        static const int flushInterval = 1; // Seconds between writes of the buffered order history
+
+        static volatile sig_atomic_t stopRequested; // Set by SIGINT/SIGTERM to end the event loop
+
+        static void requestStop(int){stopRequested = 1;}
+
+        InventoryList<Product>& productInventory; // Inventory shared by all sessions
+        InventoryList<Electronics>& electronicInventory; // Inventory shared by all sessions
+        OrderHistory& history; // Store receiving every order
+        time_t lastFlush = 0; // When the order history was last written
+        unordered_map<int, unique_ptr<Session>> sessions; // Open sessions by socket
+        vector<int> orderQueue; // Sessions whose order goes into the next checkout batch
+        int listenFd = -1;
+        int epollFd = -1;
+
+        // Split a command argument into its '|' separated fields
+        static vector<string> splitFields(const string& text){
+            vector<string> fields;
+            string field;
+            istringstream in(text);
+            while (getline(in, field, '|')) fields.push_back(field);
+            return fields;
+        }
+
+        // Check the shared stock, then add a product to the session's cart
+        template<typename T>
+        static bool addToCart(InventoryList<T>& inventory, int idx, ShoppingCart<T>& cart, int quantity, ostream& os){
+            T& item = inventory.getItem(idx);
+            if (item.getAmount() == 0) {
+                os << "ERR This product is out of stock\n";
+                return false;
+            }
+            if (quantity <= 0 || quantity > item.getAmount()) {
+                os << "ERR Invalid quantity\n";
+                return false;
+            }
+            pair<T, int> addingItem = {item, quantity};
+            cart += addingItem;
+            return true;
+        }
+
+        // Compare the prices of 2 products of the same type
+        template<typename T>
+        static void comparePrices(const T& first, const T& second, const string& firstName, const string& secondName, ostream& os){
+            if (first == second) os << firstName << "'s price is equal to " << secondName << "'s price\n";
+            else if (first > second) os << firstName << " is more expensive than " << secondName << endl;
+            else os << firstName << " is less expensive than " << secondName << endl;
+        }
+
+        // Execute one command and write its reply into the session's output buffer
+        void handleCommand(Session& session, const string& line){
+            TRACE_SCOPE("SessionServer::handleCommand");
+            ostringstream os;
+            size_t space = line.find(' ');
+            string command = line.substr(0, space);
+            string argument = (space == string::npos) ? "" : line.substr(space + 1);
+
+            if (command == "S"){ // Search the inventory
+                int productIdx = productInventory.searchItem(argument);
+                int electronicProductIdx = electronicInventory.searchItem(argument);
+                if (productIdx != -1) productInventory.getItem(productIdx).displayInfo(os);
+                else if (electronicProductIdx != -1) electronicInventory.getItem(electronicProductIdx).displayInfo(os);
+                if (productIdx != -1 || electronicProductIdx != -1) os << "OK\n";
+                else os << "ERR No results found for " << argument << endl;
+
+            } else if (command == "A"){ // Add a product to the cart
+                vector<string> fields = splitFields(argument);
+                int quantity = 0;
+                if (fields.size() != 2 || !(istringstream(fields[0]) >> quantity)) {
+                    os << "ERR Usage: A <quantity>|<name>\n";
+                } else {
+                    int productIdx = productInventory.searchItem(fields[1]);
+                    int electronicProductIdx = electronicInventory.searchItem(fields[1]);
+                    bool added = false;
+                    if (productIdx != -1) added = addToCart(productInventory, productIdx, session.productCart, quantity, os);
+                    else if (electronicProductIdx != -1) added = addToCart(electronicInventory, electronicProductIdx, session.electronicCart, quantity, os);
+                    else os << "ERR No results found for " << fields[1] << endl;
+                    if (added) os << "OK\n";
+                }
+
+            } else if (command == "R"){ // Remove a product from the cart
+                int findStatus1 = session.productCart.searchItem(argument);
+                int findStatus2 = session.electronicCart.searchItem(argument);
+                if (findStatus1 != -1) session.productCart -= session.pCartList[findStatus1];
+                else if (findStatus2 != -1) session.electronicCart -= session.eCartList[findStatus2];
+                if (findStatus1 != -1 || findStatus2 != -1) os << "OK\n";
+                else os << "ERR No results found for " << argument << endl;
+
+            } else if (command == "C"){ // Compare 2 products in the cart
+                vector<string> fields = splitFields(argument);
+                if (fields.size() != 2) {
+                    os << "ERR Usage: C <name1>|<name2>\n";
+                } else if (fields[0] == fields[1]) {
+                    os << "ERR The second product's name duplicates the first one\n";
+                } else {
+                    int p1 = session.productCart.searchItem(fields[0]), p2 = session.productCart.searchItem(fields[1]);
+                    int e1 = session.electronicCart.searchItem(fields[0]), e2 = session.electronicCart.searchItem(fields[1]);
+                    if (p1 != -1 && p2 != -1) {
+                        comparePrices(session.pCartList[p1].first, session.pCartList[p2].first, fields[0], fields[1], os);
+                        os << "OK\n";
+                    } else if (e1 != -1 && e2 != -1) {
+                        comparePrices(session.eCartList[e1].first, session.eCartList[e2].first, fields[0], fields[1], os);
+                        os << "OK\n";
+                    } else if ((p1 != -1 || e1 != -1) && (p2 != -1 || e2 != -1)) {
+                        os << "ERR Only products of the same type can be compared\n";
+                    } else {
+                        os << "ERR No results found for " << ((p1 == -1 && e1 == -1) ? fields[0] : fields[1]) << endl;
+                    }
+                }
+
+            } else if (command == "K"){ // Sort products by price
+                vector<string> fields = splitFields(argument);
+                int criterion = 0;
+                if (fields.empty() || !(istringstream(fields[0]) >> criterion) || criterion < 1 || criterion > 3) {
+                    os << "ERR Usage: K <1|2|3>[|<name>...]\n";
+                } else {
+                    PriceRanker ranker(PriceRanker::Criterion(criterion - 1));
+                    string missing;
+                    if (fields.size() == 1) {
+                        ranker.addCart(session.productCart);
+                        ranker.addCart(session.electronicCart);
+                    }
+                    for (size_t i = 1; i < fields.size() && missing.empty(); i++){
+                        int productIdx = productInventory.searchItem(fields[i]);
+                        int electronicProductIdx = electronicInventory.searchItem(fields[i]);
+                        if (productIdx != -1) ranker.add(productInventory.getItem(productIdx));
+                        else if (electronicProductIdx != -1) ranker.add(electronicInventory.getItem(electronicProductIdx));
+                        else missing = fields[i];
+                    }
+                    if (missing.empty()) {
+                        ranker.displayRanking(os);
+                        os << "OK\n";
+                    } else os << "ERR No results found for " << missing << endl;
+                }
+
+            } else if (command == "L"){ // List the cart
+                session.productCart.displayCart(os);
+                session.electronicCart.displayCart(os);
+                os << "Total: " << session.productCart.calculateTotal() + session.electronicCart.calculateTotal() << endl;
+                os << "OK\n";
+
+            } else if (command == "O"){ // Order the cart
+                if (session.pCartList.empty() && session.eCartList.empty()) {
+                    os << "ERR The cart is empty\n";
+                } else {
+                    // Checked out together with the other orders received in this round (see runCheckouts)
+                    session.ordering = true;
+                    orderQueue.push_back(session.fd);
+                }
+
+            } else if (command == "MP" || command == "ME"){ // Add a product to the inventory
+                vector<string> fields = splitFields(argument);
+                size_t expected = (command == "MP") ? 5 : 8;
+                double price = 0, rate = 0, extraFee = 0;
+                int amount = 0, power = 0, warrantyTime = 0;
+                bool valid = fields.size() == expected && isValidSku(fields[1])
+                    && (istringstream(fields[2]) >> price) && (istringstream(fields[3]) >> rate) && (istringstream(fields[4]) >> amount)
+                    && (expected == 5 || ((istringstream(fields[5]) >> power) && (istringstream(fields[6]) >> warrantyTime) && (istringstream(fields[7]) >> extraFee)));
+                if (!valid) {
+                    os << "ERR Invalid product information\n";
+                } else if (productInventory.searchKey(encodeSku(fields[1])) != -1 || electronicInventory.searchKey(encodeSku(fields[1])) != -1) {
+                    os << "ERR This ID already exists\n"; // IDs identify stock (batch checkout groups lines by ID)
+                } else if (command == "MP") {
+                    Product newItem(fields[0], fields[1], price, rate, amount);
+                    productInventory.addItem(newItem);
+                    newItem.displayInfo(os);
+                    os << "OK\n";
+                } else {
+                    Electronics newItem(fields[0], fields[1], price, rate, amount, power, warrantyTime, extraFee);
+                    electronicInventory.addItem(newItem);
+                    newItem.displayInfo(os);
+                    os << "OK\n";
+                }
+
+            } else if (command == "MR"){ // Remove a product from the inventory
+                int findingStatus1 = productInventory.searchItem(argument);
+                int findingStatus2 = electronicInventory.searchItem(argument);
+                if (findingStatus1 != -1) productInventory.removeItem(productInventory.getItem(findingStatus1), os);
+                else if (findingStatus2 != -1) electronicInventory.removeItem(electronicInventory.getItem(findingStatus2), os);
+                if (findingStatus1 != -1 || findingStatus2 != -1) os << "OK\n";
+                else os << "ERR No results found for " << argument << endl;
+
+            } else if (command == "MH"){ // Report the sales
+                history.displayReport(os);
+                os << "OK\n";
+
+            } else if (command == "Q"){ // Close the session
+                os << "OK\n";
+                session.closing = true;
+
+            } else os << "ERR Invalid command\n";
+
+            session.outBuffer += os.str();
+        }
+
+        // Accept every pending connection on the listening socket
+        void acceptClients(){
+            while (true){
+                int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd == -1) return; // No more pending connections (or a transient error)
+
+                epoll_event event{};
+                event.events = EPOLLIN | EPOLLRDHUP;
+                event.data.fd = fd;
+                if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+                    close(fd);
+                    continue;
+                }
+                sessions[fd] = make_unique<Session>(fd);
+            }
+        }
+
+        // Read what a client has sent, up to the input buffer limit
+        void readFrom(Session& session){
+            char buffer[4096];
+            while (session.inBuffer.size() < maxInput){
+                ssize_t n = read(session.fd, buffer, sizeof(buffer));
+                if (n > 0) session.inBuffer.append(buffer, n);
+                else if (n == -1 && errno == EINTR) continue;
+                else {
+                    if (n == 0) session.peerClosed = true; // End of input: the buffered commands still run
+                    else if (errno != EAGAIN && errno != EWOULDBLOCK) session.closing = true; // Connection failed
+                    break;
+                }
+            }
+        }
+
+        // Run each complete command received from a client. Stops at an order waiting for its checkout batch,
+        // and while the client has too much unread output (it resumes once the output is written).
+        void processLines(Session& session){
+            size_t start = 0, end;
+            while (!session.closing && !session.ordering && session.outBuffer.size() < maxOutput
+                   && (end = session.inBuffer.find('\n', start)) != string::npos){
+                string line = session.inBuffer.substr(start, end - start);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                start = end + 1;
+                if (!line.empty()) handleCommand(session, line);
+            }
+            session.inBuffer.erase(0, start);
+
+            bool hasCommand = session.inBuffer.find('\n') != string::npos;
+            if (!hasCommand && session.inBuffer.size() > maxLineLength) {
+                session.outBuffer += "ERR Command too long\n";
+                session.closing = true;
+            }
+
+            // Every command sent before the client finished has run: close once the replies are written
+            if (session.peerClosed && !session.ordering && !hasCommand) session.closing = true;
+        }
+
+        // Write as much of the pending output as the socket accepts; returns false if the session must be closed
+        bool flush(Session& session){
+            while (!session.outBuffer.empty()){
+                ssize_t n = send(session.fd, session.outBuffer.data(), session.outBuffer.size(), MSG_NOSIGNAL);
+                if (n > 0) session.outBuffer.erase(0, n);
+                else if (n == -1 && errno == EINTR) continue;
+                else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                else return false;
+            }
+
+            // Only read while the session can take more input (backpressure), and only wait for the socket
+            // to become writable while output is pending
+            epoll_event event{};
+            event.events = 0;
+            if (!session.peerClosed && !session.closing && session.inBuffer.size() < maxInput && session.outBuffer.size() < maxOutput)
+                event.events |= EPOLLIN | EPOLLRDHUP;
+            if (!session.outBuffer.empty()) event.events |= EPOLLOUT;
+            event.data.fd = session.fd;
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, session.fd, &event);
+
+            return !(session.closing && session.outBuffer.empty());
+        }
+
+        // Run a session's pending commands and write their replies; returns false if the session must be closed
+        bool serve(Session& session){
+            while (true){
+                processLines(session);
+                if (!flush(session)) return false;
+
+                // Continue only if commands were paused for output that has now been written in full
+                if (!session.outBuffer.empty() || session.ordering || session.closing || session.inBuffer.find('\n') == string::npos) return true;
+            }
+        }
+
+        // Close a session and forget its state
+        void closeSession(int fd){
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            sessions.erase(fd);
+            orderQueue.erase(remove(orderQueue.begin(), orderQueue.end(), fd), orderQueue.end());
+        }
+
+        // Check out every queued order in one batch, reply to each session and resume its remaining commands
+        void runCheckouts(){
+            TRACE_SCOPE("SessionServer::runCheckouts");
+            while (!orderQueue.empty()){
+                vector<int> queued;
+                queued.swap(orderQueue);
+
+                CheckoutBatch batch(productInventory, electronicInventory);
+                for (int fd : queued) batch.add(sessions[fd]->productCart, sessions[fd]->electronicCart);
+                vector<bool> accepted = batch.run();
+
+                for (size_t i = 0; i < queued.size(); i++){
+                    Session& session = *sessions[queued[i]];
+                    ostringstream os;
+                    if (accepted[i]) {
+                        Order newOrder;
+                        newOrder.createOrder(session.productCart, session.electronicCart);
+                        newOrder.displayOrder(session.productCart, session.electronicCart, os);
+                        history.append(newOrder);
+                        session.productCart.clear();
+                        session.electronicCart.clear();
+                        os << "OK\n";
+                    } else os << "ERR Some products in the cart are no longer in stock\n";
+                    session.outBuffer += os.str();
+
+                    session.ordering = false;
+                }
+
+                // Resume the sessions' remaining commands (they may queue another order for the next batch)
+                for (int fd : queued){
+                    if (sessions.count(fd) && !serve(*sessions[fd])) closeSession(fd);
+                }
+            }
+        }
+
+    public:
+        // Initialize the server with the inventories it shares between sessions
+        SessionServer(InventoryList<Product>& _productInventory, InventoryList<Electronics>& _electronicInventory, OrderHistory& _history)
+        : productInventory(_productInventory), electronicInventory(_electronicInventory), history(_history){}
+
+        ~SessionServer(){
+            for (auto& s : sessions) close(s.first);
+            if (epollFd != -1) close(epollFd);
+            if (listenFd != -1) close(listenFd);
+        }
+
+        // Listen on the given socket path and serve clients until stopped by a signal (returns the exit status)
+        int run(const string& socketPath){
+            // Stop cleanly on SIGINT/SIGTERM so the buffered order history is written
+            struct sigaction stopAction{};
+            stopAction.sa_handler = requestStop;
+            sigaction(SIGINT, &stopAction, nullptr);
+            sigaction(SIGTERM, &stopAction, nullptr);
+
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (socketPath.size() >= sizeof(address.sun_path)) {
+                cerr << "Socket path is too long: " << socketPath << endl;
+                return 1;
+            }
+            socketPath.copy(address.sun_path, socketPath.size());
+            unlink(socketPath.c_str()); // Remove a socket left over by a previous run
+
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd == -1 || bind(listenFd, (sockaddr*)&address, sizeof(address)) == -1 || listen(listenFd, SOMAXCONN) == -1) {
+                perror("Cannot listen on socket");
+                return 1;
+            }
+
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            epoll_event listenEvent{};
+            listenEvent.events = EPOLLIN;
+            listenEvent.data.fd = listenFd;
+            if (epollFd == -1 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent) == -1) {
+                perror("Cannot create event loop");
+                return 1;
+            }
+
+            cout << "Serving on " << socketPath << endl;
+            epoll_event events[maxEvents];
+            while (!stopRequested){
+                // Write the buffered order history at most once per interval
+                if (history.pendingLines() > 0 && time(nullptr) - lastFlush >= flushInterval) {
+                    history.flush();
+                    lastFlush = time(nullptr);
+                }
+
+                int count = epoll_wait(epollFd, events, maxEvents, history.pendingLines() > 0 ? flushInterval * 1000 : -1);
+                if (count == -1) {
+                    if (errno == EINTR) continue;
+                    perror("Event loop failed");
+                    return 1;
+                }
+
+                for (int i = 0; i < count; i++){
+                    int fd = events[i].data.fd;
+                    if (fd == listenFd) {
+                        acceptClients();
+                        continue;
+                    }
+
+                    auto it = sessions.find(fd);
+                    if (it == sessions.end()) continue;
+                    Session& session = *it->second;
+
+                    if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) readFrom(session);
+                    if (!serve(session)) closeSession(fd); // Also resumes commands paused until output was written
+                }
+
+                runCheckouts();
+            }
+
+            history.flush();
+            return 0;
+        }
+};
+
+volatile sig_atomic_t SessionServer::stopRequested = 0;
+
+int main(int argc, char* argv[]){
+    // Build the starting stock from the compile-time seed catalog
+    vector<Product> productStorage; // Regular products
+    vector<Electronics> electronicsStorage; // Electronic products
+    for (const CatalogEntry& e : seedCatalog){
+        if (e.electronic) electronicsStorage.push_back(Electronics(string(e.name), string(e.ID), e.price, e.rate, e.amount, e.power, e.warrantyTime, e.extraFee));
+        else productStorage.push_back(Product(string(e.name), string(e.ID), e.price, e.rate, e.amount));
+    }
+
     // Initialize inventories
     InventoryList<Product> productInventory(productStorage); // Inventory of regular products
     InventoryList<Electronics> electronicInventory(electronicsStorage); // Inventory of electronics
@@ -281,6 +1939,24 @@ int main(){
     ShoppingCart<Product> productCart(pCartList); // Shopping cart for regular products
     ShoppingCart<Electronics> electronicCart(eCartList);  // Shopping cart for electronics
 
+    // Persistent history of all orders
+    OrderHistory history("order_history");
+
+    // Command-line options: --serve <socket path> and --trace <trace file>
+    string socketPath, tracePath;
+    for (int i = 1; i + 1 < argc; i += 2){
+        string option = argv[i];
+        if (option == "--serve") socketPath = argv[i + 1];
+        else if (option == "--trace") tracePath = argv[i + 1];
+    }
+    if (!tracePath.empty()) Tracer::start(tracePath); // Record hot paths and export them when the program exits
+
+    // Server mode: serve many clients over a Unix domain socket instead of the console
+    if (!socketPath.empty()){
+        SessionServer server(productInventory, electronicInventory, history);
+        return server.run(socketPath);
+    }
+
     // Ask the user to choose a role
     cout << "Choose your role:\n";
     cout << "1. Customer\n";
@@ -401,6 +2077,7 @@ int main(){
             cout << "2. Add product\n"; // Add more products to the cart
             cout << "3. Remove product\n";  // Remove a product from the cart
             cout << "4. Compare 2 products\n"; // Compare prices of 2 products
+            cout << "5. Sort products\n"; // Rank all products in the cart by price
             cout << "Choose: ";
             int choice; cin >> choice;
 
@@ -409,6 +2086,7 @@ int main(){
                 Order newOrder; // Create a new order from the cart
                 newOrder.createOrder(productCart, electronicCart); // Save cart items into the order and update inventory quantities
                 newOrder.displayOrder(productCart, electronicCart); // Display detailed order information, including products, prices, and total
+                history.append(newOrder); // Record the order in the order history
                 return 0; // End the program after placing the order
             } else if (choice == 2){ // Add products to the cart
                 while (true){
@@ -615,6 +2293,24 @@ int main(){
                     cout << "Invalid\n"; // Invalid product type selection
                     return 0;
                 }
+            } else if (choice == 5){ // Rank all products in the cart (both types) by price
+                cout << "\nChoose how to sort the products:\n";
+                cout << "1. Price\n";
+                cout << "2. Price after discount\n";
+                cout << "3. Savings\n";
+                cout << "Choose: ";
+                int sortChoice; cin >> sortChoice;
+                cout << endl;
+                if (sortChoice < 1 || sortChoice > 3) {
+                    cout << "Invalid\n"; // Invalid sort selection
+                    return 0;
+                }
+
+                PriceRanker ranker(PriceRanker::Criterion(sortChoice - 1));
+                ranker.addCart(productCart);
+                ranker.addCart(electronicCart);
+                ranker.displayRanking();
+                cout << endl;
             } else {
                 cout << "Invalid\n"; // Invalid menu option
                 return 0;
@@ -624,6 +2320,7 @@ int main(){
         cout << "Choose function:\n";
         cout << "1. Add product\n";
         cout << "2. Remove product\n";
+        cout << "3. Sales report\n";
         cout << "Choose: ";
         int choice; cin >> choice;
         cout << "=======================================\n";
@@ -647,6 +2344,14 @@ int main(){
             string name; getline(cin, name); // Enter product name
             cout << "ID: ";
             string ID; cin >> ID; // Enter product ID
+            if (!isValidSku(ID)) { // IDs are limited to 8 characters
+                cout << "Invalid\n";
+                return 0;
+            }
+            if (productInventory.searchKey(encodeSku(ID)) != -1 || electronicInventory.searchKey(encodeSku(ID)) != -1) {
+                cout << "This ID already exists\n"; // Every product needs its own ID
+                return 0;
+            }
             cout << "Price: ";
             double price; cin >> price; // Enter product price
             
@@ -707,6 +2412,8 @@ int main(){
                 if (findingStatus2 != -1) electronicInventory.removeItem(electronicInventory.getStorage()[findingStatus2]); // Remove electronic product
                 else cout << "No results found for " << productName << endl; // Case when product not found
             }
+        } else if (choice == 3){ // Show the best sellers and the revenue from the order history
+            history.displayReport();
         } else cout << "Invalid\n"; // Invalid choice
     } else cout << "Invalid\n";  
 }
@@ -800,6 +2507,7 @@ Choose function:
 2. Add product
 3. Remove product
 4. Compare 2 products
+5. Sort products
 Choose: 2
 
 Enter product you want to buy: Backpack X
@@ -837,6 +2545,7 @@ Choose function:
 2. Add product
 3. Remove product
 4. Compare 2 products
+5. Sort products
 Choose: 1
 =====================
 ORDER DETAILS:
@@ -856,4 +2565,31 @@ Price: 60
 Quantity: 1
 
 Total: 872.5
+- Test case 2 (an ID that is already in the inventory is rejected):
++ Input:
+2
+1
+1
+Notebook
+P001
++ Output:
+Choose your role:
+1. Customer
+2. Manager
+Choose: 2
+=================
+Choose function:
+1. Add product
+2. Remove product
+3. Sales report
+Choose: 1
+=======================================
+Choose type of product you want to add:
+1. Product
+2. Electronic Product
+Choose: 1
+Enter product information:
+Name: Notebook
+ID: P001
+This ID already exists
 */
\ No newline at end of file